@@ -1,15 +1,17 @@
 //
 // -- bin2hex.c
 //
-#include <ctype.h>
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "intel_format.h"
+#include "split.h"
 
 // -- default number of output bytes per record
-static const int k_bytes_per_record = 32;
+enum { k_bytes_per_record = 32 };
+// -- maximum chunk size
+enum { k_max_chunk = 65536 };
 
 // -- print usage message
 static void
@@ -21,20 +23,27 @@ usage() {
             "  writes to stdout (or file specified by the -o option)\n"
             "options:\n"
             "  -a|--address address: starting address (default 0)\n"
-            "  -o|--output file: output\n");
+            "  -b|--banks address,...: split output at bank boundaries\n"
+            "  -f|--fill byte: skip split chunks holding only this byte (default 0)\n"
+            "  -o|--output file: output\n"
+            "  -s|--split size: split output into size aligned chunks\n");
     exit(EXIT_FAILURE);
 }
 
 // -- program options
-static char *short_options = "a:o:";
+static char *short_options = "a:b:f:o:s:";
 static struct option long_options[] = {
     {"address", required_argument, 0, 'a'},
+    {"banks",   required_argument, 0, 'b'},
+    {"fill",    required_argument, 0, 'f'},
     {"output",  required_argument, 0, 'o'},
+    {"split",   required_argument, 0, 's'},
     {0, 0, 0, 0}
 };
 
 static FILE *in_fp;
 static FILE *out_fp;
+static char *out_path;
 
 // -- record data
 static byte_type data[k_bytes_per_record];
@@ -43,50 +52,70 @@ static address_type offset;
 // -- default start address
 static address_type start_address;
 
+// -- output split
+static split_spec split;
+static byte_type fill;
+static byte_type chunk[k_max_chunk];
+
 //
-// -- scan for an address
-static address_type
-strtoaddr(const char *str) {
-    const char *ptr = str;
-    unsigned int radix = 10;
-    // -- advance past hexadecimal digits
-    while (isxdigit(*ptr)) {
-        ++ptr;
+// -- write a complete Intel hex format file for a chunk
+// -- fp     - output file pointer
+// -- base   - chunk base address
+// -- binbuf - binary data
+// -- binlen - number of binary data bytes
+static void
+write_chunk(FILE *fp, address_type base,
+            const byte_type *binbuf, int binlen) {
+    write_ela_record(fp, 0x0000);
+    for (int i = 0; i < binlen; i += k_bytes_per_record) {
+        int reclen = binlen - i;
+        if (reclen > k_bytes_per_record) reclen = k_bytes_per_record;
+        write_data_record(fp, (address_type) (base + i), binbuf + i, reclen);
     }
-    // -- test for radix tag
-    if (toupper(*ptr) == 'O' || toupper(*ptr) == 'Q') {
-        radix = 8;
-    } else if (toupper(*ptr) == 'H') {
-        radix = 16;
-    } else {
-        --ptr;
-        if (toupper(*ptr) == 'B') {
-            radix = 2;
-        } else if (toupper(*ptr) == 'D') {
-            radix = 10;
-        } else {
-            ++ptr;
-        }
+    write_eof_record(fp, 0x0000);
+    // -- check output file status
+    if (ferror(fp)) {
+        perror("write");
+        exit(EXIT_FAILURE);
     }
-    
-    unsigned int value = 0;
-    while (str < ptr) {
-        int ch = toupper(*str++);
-        unsigned int digit = (ch >= 'A') ? (ch - 'A' + 10) : (ch - '0');
-        value = value * radix + digit;
-        if (digit >= radix || value > 0xFFFF) {
-            fprintf(stderr, "invalid address\n");
+}
+
+//
+// -- split the input into chunks, one output file per chunk
+static void
+split_input() {
+    uint32_t address = start_address;
+    for (;;) {
+        // -- read the chunk containing the address
+        uint32_t end = chunk_end(&split, address);
+        int read_count = (int) fread(chunk, 1, end - address, in_fp);
+        if (ferror(in_fp)) {
+            perror("read");
+            exit(EXIT_FAILURE);
+        }
+        if (read_count == 0) break;
+
+        // -- skip chunks holding only fill
+        if (!chunk_is_fill(chunk, read_count, fill)) {
+            FILE *fp = open_chunk(out_path, address);
+            write_chunk(fp, (address_type) address, chunk, read_count);
+            fclose(fp);
+        }
+        address += read_count;
+
+        // -- the next chunk would fall outside the address space
+        if (address == end && end == k_address_limit &&
+            fgetc(in_fp) != EOF) {
+            fprintf(stderr, "input exceeds address space\n");
             exit(EXIT_FAILURE);
         }
     }
-    return (address_type) value;
 }
 
 //
 // -- main program
 int
 main(int argc, char *argv[]) {
-    out_fp = stdout;
     // -- process command line arguments
     int option_index = 0;
     int ch;
@@ -98,13 +127,21 @@ main(int argc, char *argv[]) {
                 // -- start address
                 start_address = strtoaddr(optarg);
                 break;
+            case 'b':
+                // -- bank boundaries
+                parse_banks(optarg, &split);
+                break;
+            case 'f':
+                // -- fill byte
+                fill = strtobyte(optarg);
+                break;
             case 'o':
                 // -- output
-                out_fp = fopen(optarg, "w");
-                if (!out_fp) {
-                    perror("open");
-                    exit(EXIT_FAILURE);
-                }
+                out_path = optarg;
+                break;
+            case 's':
+                // -- chunk size
+                parse_size(optarg, &split);
                 break;
             default:
                 usage();
@@ -124,6 +161,29 @@ main(int argc, char *argv[]) {
         }
     }
 
+    //
+    // -- split output goes to one file per chunk
+    if (split_enabled(&split)) {
+        if (!out_path) {
+            fprintf(stderr, "split output requires an output file\n");
+            exit(EXIT_FAILURE);
+        }
+        split_input();
+        fclose(in_fp);
+        return EXIT_SUCCESS;
+    }
+
+    // -- open output file
+    if (!out_path) {
+        out_fp = stdout;
+    } else {
+        out_fp = fopen(out_path, "w");
+        if (!out_fp) {
+            perror("open");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     //
     // -- generate extended linear address record
     write_ela_record(out_fp, 0x0000);
@@ -1,17 +1,22 @@
 //
 // -- hex2bin.c
 //
+#include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "intel_format.h"
+#include "split.h"
 
 // -- maximum data
-static const int k_max_data = 256;
+enum { k_max_data = 256 };
 // -- maximum memory
-static const int k_max_memory = 65536;
+enum { k_max_memory = 65536 };
 // -- maximum warnings
 static const int k_max_warnings = 10;
 
@@ -23,19 +28,34 @@ usage() {
             "  convert Intel hexadecimal object file to binary file format\n"
             "  reads from file (or stdin if file not given on command line)\n"
             "  writes to stdout (or file specified by the -o option)\n"
-            "option:\n"
-            "  -o|--output file: output\n");
+            "options:\n"
+            "  -b|--banks address,...: split output at bank boundaries\n"
+            "  -c|--check: report overlapping records and a segment summary\n"
+            "  -d|--fd descriptor: decode into an open file (e.g. a memfd)\n"
+            "  -f|--fill byte: fill byte for gaps (default 0)\n"
+            "  -m|--shm name: decode into a POSIX shared memory object\n"
+            "  -o|--output file: output\n"
+            "  -s|--split size: split output into size aligned chunks\n"
+            "  -x|--strict: fail if records overlap with conflicting data\n");
 }
 
 // -- program options
-static char *short_options = "o:";
+static char *short_options = "b:cd:f:m:o:s:x";
 static struct option long_options[] = {
+    {"banks",   required_argument, 0, 'b'},
+    {"check",   no_argument,       0, 'c'},
+    {"fd",      required_argument, 0, 'd'},
+    {"fill",    required_argument, 0, 'f'},
+    {"shm",     required_argument, 0, 'm'},
     {"output",  required_argument, 0, 'o'},
+    {"split",   required_argument, 0, 's'},
+    {"strict",  no_argument,       0, 'x'},
     {0, 0, 0, 0}
 };
 
 static FILE *in_fp;
 static FILE *out_fp;
+static char *out_path;
 
 // -- input line buffer
 static char *line;
@@ -46,18 +66,295 @@ static byte_type data[k_max_data];
 static address_type offset;
 static int reclen;
 
-// -- binary memory space
-static byte_type memory[k_max_memory];
+// -- binary memory space, the static image unless mapped from a file
+static byte_type image[k_max_memory];
+static byte_type *memory = image;
 static address_type start_address = 0xffff;
-static address_type end_address = 0x0000;
+static uint32_t end_address = 0x0000;
+
+// -- coverage of the memory space, one bit per byte written by a record
+static uint32_t coverage[k_max_memory / 32];
+
+// -- layout checking
+static bool check_layout;
+static bool strict_layout;
+static int duplicate_count;
+static int conflict_count;
+
+// -- base address from extended linear or segment address records,
+// -- the image holds the 64K above the base of the first data record
+static uint32_t upper_address;
+static uint32_t image_upper;
+static bool has_image_upper;
+static bool outside_reported;
+
+// -- mapped image file
+static int map_fd = -1;
+static char *shm_name;
 
 static int warning_count;
 
+// -- output split
+static split_spec split;
+static byte_type fill;
+
+//
+// -- report an input warning, up to the maximum warning count
+// -- line_count - input line number
+// -- message    - warning message
+static void
+warning(int line_count, const char *message) {
+    ++warning_count;
+    if (warning_count < k_max_warnings) {
+        fprintf(stderr, "line %d: %s\n", line_count, message);
+    } else if (warning_count == k_max_warnings) {
+        fprintf(stderr, "line %d: too many warnings, will no longer report\n", line_count);
+    }
+}
+
+//
+// -- scan for a file descriptor
+// -- str - decimal file descriptor number
+//
+// -- exit the program if the file descriptor is invalid
+static int
+strtofd(const char *str) {
+    char *end;
+    long value = strtol(str, &end, 10);
+    if (end == str || *end != '\0' || value < 0 || value > INT_MAX) {
+        fprintf(stderr, "invalid file descriptor\n");
+        exit(EXIT_FAILURE);
+    }
+    return (int) value;
+}
+
+//
+// -- fail to map the memory space
+// -- a shared memory object created for the image is removed again
+// -- message - error message for perror
+static void
+fail_map(const char *message) {
+    perror(message);
+    if (shm_name) shm_unlink(shm_name);
+    exit(EXIT_FAILURE);
+}
+
+//
+// -- map the memory space onto a file so the decoded image is shared
+// -- fd - file descriptor of a memfd, shared memory object or regular file
+static void
+map_memory(int fd) {
+    if (ftruncate(fd, k_max_memory) != 0) {
+        fail_map("truncate");
+    }
+    void *addr = mmap(NULL, k_max_memory, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        fail_map("mmap");
+    }
+    memory = addr;
+}
+
+//
+// -- mark the bytes written by a data record as covered, a word at a time
+// -- must be called before the record is stored into memory
+// -- address     - load offset
+// -- binbuf      - binary data
+// -- binlen      - number of binary data bytes
+// -- p_conflicts - pointer for the returned number of already covered
+// --                 bytes the record changes
+//
+// -- return the number of bytes already covered by earlier records
+static int
+mark_coverage(uint32_t address, const byte_type *binbuf, int binlen,
+              int *p_conflicts) {
+    int overlaps = 0;
+    *p_conflicts = 0;
+    uint32_t end = address + binlen;
+    for (uint32_t i = address; i < end; ) {
+        // -- bits of this record within the coverage word
+        uint32_t bit = i % 32;
+        uint32_t count = 32 - bit;
+        if (count > end - i) count = end - i;
+        uint32_t mask = (count == 32) ? ~(uint32_t) 0
+                                      : (((uint32_t) 1 << count) - 1) << bit;
+
+        // -- compare only the bytes that were already written
+        uint32_t covered = (coverage[i / 32] & mask) >> bit;
+        for (uint32_t j = i; covered != 0; ++j, covered >>= 1) {
+            if (covered & 1) {
+                ++overlaps;
+                if (memory[j] != binbuf[j - address]) ++*p_conflicts;
+            }
+        }
+        coverage[i / 32] |= mask;
+        i += count;
+    }
+    return overlaps;
+}
+
+//
+// -- test if a byte was written by a data record
+// -- address - memory address
+static bool
+is_covered(uint32_t address) {
+    return (coverage[address / 32] >> (address % 32)) & 1;
+}
+
+//
+// -- find the next segment of covered bytes
+// -- address - address to start searching from
+// -- p_end   - pointer for the returned end (exclusive) of the segment
+//
+// -- return the segment start, or k_max_memory if no segment remains
+static uint32_t
+next_segment(uint32_t address, uint32_t *p_end) {
+    while (address < k_max_memory && !is_covered(address)) {
+        // -- skip empty coverage words whole
+        if (address % 32 == 0 && coverage[address / 32] == 0) {
+            address += 32;
+        } else {
+            ++address;
+        }
+    }
+    uint32_t end = address;
+    while (end < k_max_memory && is_covered(end)) {
+        // -- skip full coverage words whole
+        if (end % 32 == 0 && coverage[end / 32] == ~(uint32_t) 0) {
+            end += 32;
+        } else {
+            ++end;
+        }
+    }
+    *p_end = end;
+    return address;
+}
+
+//
+// -- report overlapping bytes of a data record
+// -- line_count - input line number
+// -- address    - load offset
+// -- overlaps   - number of bytes already covered by earlier records
+// -- conflicts  - number of those bytes the record changes
+static void
+report_overlap(int line_count, uint32_t address, int overlaps, int conflicts) {
+    if (conflicts > 0) {
+        ++conflict_count;
+    } else {
+        ++duplicate_count;
+    }
+    if (!check_layout) return;
+
+    // -- every overlap is reported, independent of the warning count
+    if (conflicts > 0) {
+        fprintf(stderr, "line %d: record at %04X overlaps %d bytes, %d conflicting\n",
+                line_count, address, overlaps, conflicts);
+    } else {
+        fprintf(stderr, "line %d: record at %04X overlaps %d bytes with identical data\n",
+                line_count, address, overlaps);
+    }
+}
+
+//
+// -- fail a strict layout check
+// -- a shared image is discarded so no half valid image is left behind
+static void
+fail_layout() {
+    if (map_fd >= 0) {
+        munmap(memory, k_max_memory);
+        if (shm_name) {
+            shm_unlink(shm_name);
+        } else if (ftruncate(map_fd, 0) != 0) {
+            perror("truncate");
+        }
+    }
+    exit(EXIT_FAILURE);
+}
+
+//
+// -- write the segment and gap summary of the decoded image to stderr
+static void
+write_layout_summary() {
+    int segment_count = 0;
+    uint32_t covered_size = 0;
+    uint32_t gap_size = 0;
+    uint32_t previous_end = 0;
+    uint32_t end;
+    for (uint32_t address = next_segment(0, &end);
+         address < k_max_memory;
+         address = next_segment(end, &end)) {
+        if (segment_count > 0) {
+            fprintf(stderr, "gap     %04X-%04X %6u bytes\n",
+                    previous_end, address - 1, address - previous_end);
+            gap_size += address - previous_end;
+        }
+        fprintf(stderr, "segment %04X-%04X %6u bytes\n",
+                address, end - 1, end - address);
+        covered_size += end - address;
+        previous_end = end;
+        ++segment_count;
+    }
+    fprintf(stderr, "%d segments, %u bytes, %u gap bytes\n",
+            segment_count, covered_size, gap_size);
+    fprintf(stderr, "%d conflicting and %d duplicate overlapping records\n",
+            conflict_count, duplicate_count);
+}
+
+//
+// -- write the mapped image handle and its segment map
+// -- the base address the image is loaded at, then one "start length"
+// -- line in hexadecimal per populated range, relative to the base
+static void
+write_segment_map() {
+    if (shm_name) {
+        fprintf(out_fp, "shm %s\n", shm_name);
+    } else {
+        fprintf(out_fp, "fd %d\n", map_fd);
+    }
+    fprintf(out_fp, "size %X\n", k_max_memory);
+    fprintf(out_fp, "base %X\n", image_upper);
+    uint32_t end;
+    for (uint32_t address = next_segment(0, &end);
+         address < k_max_memory;
+         address = next_segment(end, &end)) {
+        fprintf(out_fp, "segment %04X %04X\n", address, end - address);
+    }
+    if (ferror(out_fp)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+// -- write the memory image split into chunks, one output file per chunk
+static void
+write_chunks() {
+    uint32_t address = start_address;
+    while (address < end_address) {
+        uint32_t end = chunk_end(&split, address);
+        if (end > end_address) end = end_address;
+
+        // -- skip chunks no record wrote into
+        int chunk_size = end - address;
+        uint32_t segment_end;
+        if (next_segment(address, &segment_end) < end) {
+            FILE *fp = open_chunk(out_path, address);
+            int write_count = (int) fwrite(memory + address,
+                                           1, chunk_size, fp);
+            if (write_count != chunk_size) {
+                perror("write");
+                exit(EXIT_FAILURE);
+            }
+            fclose(fp);
+        }
+        address = end;
+    }
+}
+
 //
 // -- main program
 int
 main(int argc, char *argv[]) {
-    out_fp = stdout;
     // -- process command line arguments
     int option_index = 0;
     int ch;
@@ -65,13 +362,38 @@ main(int argc, char *argv[]) {
                              short_options, long_options,
                              &option_index)) != -1) {
         switch (ch) {
+            case 'b':
+                // -- bank boundaries
+                parse_banks(optarg, &split);
+                break;
+            case 'c':
+                // -- layout check
+                check_layout = true;
+                break;
+            case 'd':
+                // -- file descriptor
+                map_fd = strtofd(optarg);
+                break;
+            case 'f':
+                // -- fill byte
+                fill = strtobyte(optarg);
+                break;
+            case 'm':
+                // -- shared memory object
+                shm_name = optarg;
+                break;
             case 'o':
                 // -- output
-                out_fp = fopen(optarg, "w");
-                if (!out_fp) {
-                    perror("open");
-                    exit(EXIT_FAILURE);
-                }
+                out_path = optarg;
+                break;
+            case 's':
+                // -- chunk size
+                parse_size(optarg, &split);
+                break;
+            case 'x':
+                // -- strict layout check
+                check_layout = true;
+                strict_layout = true;
                 break;
             default:
                 usage();
@@ -90,6 +412,35 @@ main(int argc, char *argv[]) {
             exit(EXIT_FAILURE);
         }
     }
+
+    // -- map the memory space when decoding into shared memory
+    if (shm_name && map_fd >= 0) {
+        fprintf(stderr, "-d and -m cannot be combined\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((shm_name || map_fd >= 0) && split_enabled(&split)) {
+        fprintf(stderr, "split output cannot be combined with shared memory\n");
+        exit(EXIT_FAILURE);
+    }
+    if (shm_name) {
+        map_fd = shm_open(shm_name, O_RDWR | O_CREAT, 0600);
+        if (map_fd < 0) {
+            perror("shm_open");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (map_fd >= 0) {
+        map_memory(map_fd);
+    }
+
+    // -- split output goes to one file per chunk
+    if (split_enabled(&split) && !out_path) {
+        fprintf(stderr, "split output requires an output file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // -- gaps between records hold the fill byte
+    memset(memory, fill, k_max_memory);
     
     //
     // -- parse the input to retrieve binary data
@@ -106,6 +457,9 @@ main(int argc, char *argv[]) {
         // -- return  1 if a valid end of file record
         // -- return  2 if a valid extended linear address record
         // -- return  3 if a valid yet ignorable record
+        // -- return  4 if a valid start segment address record
+        // -- return  5 if a valid start linear address record
+        // -- return  6 if a valid extended segment address record
         int status = parse_record(line, read_count,
                                   data, k_max_data,
                                   &offset,
@@ -115,25 +469,52 @@ main(int argc, char *argv[]) {
             fprintf(stderr, "line %d: line too long\n", line_count);
             exit(EXIT_FAILURE);
         } else if (status == -2 || status == -1) {
-            ++warning_count;
-            if (warning_count < k_max_warnings) {
-                fprintf(stderr, "line %d: invalid record format\n", line_count);
-            } else if (warning_count == k_max_warnings) {
-                fprintf(stderr, "line %d: too many warnings, will no longer report\n", line_count);
-            }
+            warning(line_count, "invalid record format");
+        } else if (status == 0 && offset + reclen > k_max_memory) {
+            warning(line_count, "record exceeds address space");
         } else if (status == 0) {
             // -- data record
+            // -- records above another base address are folded into the image
+            if (!has_image_upper) {
+                image_upper = upper_address;
+                has_image_upper = true;
+            }
+            bool outside = upper_address != image_upper;
+            if (outside && strict_layout) {
+                fprintf(stderr, "line %d: record outside the 64K image\n", line_count);
+                fail_layout();
+            } else if (outside && !outside_reported) {
+                warning(line_count, "image exceeds 64K, upper address ignored");
+                outside_reported = true;
+            }
+            // -- detect overlaps before the earlier data is overwritten,
+            // -- folded records stay out of the coverage, they would only
+            // -- cause false overlaps and segments
+            if (!outside) {
+                int conflicts;
+                int overlaps = mark_coverage(offset, data, reclen, &conflicts);
+                if (overlaps > 0) {
+                    report_overlap(line_count, offset, overlaps, conflicts);
+                }
+            }
             // -- store data into memory buffer
             for (int i = 0; i < reclen; ++i) {
                 memory[offset + i] = data[i];
             }
             // -- adjust memory bounds
             if (start_address > offset) start_address = offset;
-            if (end_address < offset + reclen) end_address = offset + reclen;
+            uint32_t record_end = (uint32_t) offset + reclen;
+            if (end_address < record_end) end_address = record_end;
         } else if (status == 1) {
             // -- eof record
             // -- exit loop
             break;
+        } else if (status == 2) {
+            // -- extended linear address record
+            upper_address = (uint32_t) offset << 16;
+        } else if (status == 6) {
+            // -- extended segment address record
+            upper_address = (uint32_t) offset << 4;
         }
         // -- otherwise skip line
     }
@@ -142,9 +523,47 @@ main(int argc, char *argv[]) {
         perror("read");
         exit(EXIT_FAILURE);
     }
+
+    //
+    // -- report the layout, conflicting overlaps are fatal when strict
+    if (check_layout) {
+        write_layout_summary();
+    }
+    if (strict_layout && conflict_count > 0) {
+        fprintf(stderr, "conflicting overlapping records\n");
+        fail_layout();
+    }
+
+    // -- open output file, only once the image is known to be good
+    // -- chunk files are opened as they are written
+    if (!out_path) {
+        out_fp = stdout;
+    } else if (!split_enabled(&split)) {
+        out_fp = fopen(out_path, "w");
+        if (!out_fp) {
+            perror("open");
+            exit(EXIT_FAILURE);
+        }
+    }
     
+    //
+    // -- the image is already in place, hand back its segment map
+    if (map_fd >= 0) {
+        write_segment_map();
+        munmap(memory, k_max_memory);
+        close(map_fd);
+        fclose(in_fp);
+        fclose(out_fp);
+        return EXIT_SUCCESS;
+    }
+
     //
     // -- write the binary data
+    if (split_enabled(&split)) {
+        write_chunks();
+        fclose(in_fp);
+        return EXIT_SUCCESS;
+    }
     int memory_size = end_address - start_address;
     int write_count = (int) fwrite(memory + start_address,
                                    1, memory_size, out_fp);
@@ -0,0 +1,347 @@
+//
+// -- hex2hex.c
+//
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intel_format.h"
+#include "split.h"
+
+// -- maximum data
+enum { k_max_data = 256 };
+// -- maximum output bytes per record
+enum { k_max_record = 255 };
+// -- maximum warnings
+static const int k_max_warnings = 10;
+
+// -- print usage message
+static void
+usage() {
+    fprintf(stderr,
+            "usage: hex2hex [options] [file]\n"
+            "  normalize an Intel hexadecimal object file\n"
+            "  reads from file (or stdin if file not given on command line)\n"
+            "  writes to stdout (or file specified by the -o option)\n"
+            "options:\n"
+            "  -l|--length count: maximum bytes per data record (default 255)\n"
+            "  -o|--output file: output\n"
+            "  -s|--sort: sort data records by address\n");
+    exit(EXIT_FAILURE);
+}
+
+// -- program options
+static char *short_options = "l:o:s";
+static struct option long_options[] = {
+    {"length",  required_argument, 0, 'l'},
+    {"output",  required_argument, 0, 'o'},
+    {"sort",    no_argument,       0, 's'},
+    {0, 0, 0, 0}
+};
+
+static FILE *in_fp;
+static FILE *out_fp;
+
+// -- input line buffer
+static char *line;
+static size_t line_size;
+
+// -- record data buffer
+static byte_type data[k_max_data];
+static address_type offset;
+static int reclen;
+
+// -- options
+static int record_length = k_max_record;
+static bool sort_records;
+
+// -- upper linear and segment base address of the input
+// -- only one is in effect, the other is zero
+static uint32_t in_ulba;
+static uint32_t in_usba;
+// -- upper linear base address of the output
+static uint32_t out_ulba;
+
+// -- pending output data record
+static byte_type pending[k_max_record];
+static uint32_t pending_address;
+static int pending_len;
+
+// -- start address records
+static bool has_ssa;
+static uint32_t ssa_address;
+static bool has_sla;
+static uint32_t sla_address;
+static address_type eof_address;
+
+// -- buffered data records for sorting
+// -- a sorted file cannot be written until every record has been read, an
+// -- out of order record may belong before all the data seen so far; input
+// -- that is already ordered needs no sorting and is streamed without -s
+typedef struct sort_record {
+    uint32_t address;   // -- linear load address
+    int index;          // -- input order, keeps the sort stable
+    int binlen;         // -- number of data bytes
+    size_t position;    // -- position of the data bytes in sort_data
+} sort_record;
+
+static sort_record *sort_list;
+static int sort_count;
+static int sort_capacity;
+static byte_type *sort_data;
+static size_t sort_data_size;
+static size_t sort_data_capacity;
+
+static int warning_count;
+
+//
+// -- check the output file status
+static void
+check_output() {
+    if (ferror(out_fp)) {
+        perror("write");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+// -- write the pending data record
+// -- an extended linear address record is written only when the upper
+// -- linear base address changes
+static void
+flush_pending() {
+    if (pending_len == 0) return;
+
+    uint32_t ulba = pending_address >> 16;
+    if (ulba != out_ulba) {
+        write_ela_record(out_fp, (address_type) ulba);
+        out_ulba = ulba;
+    }
+    write_data_record(out_fp, (address_type) pending_address,
+                      pending, pending_len);
+    check_output();
+    pending_len = 0;
+}
+
+//
+// -- add data to the output, coalescing it with the pending data record
+// -- address - linear load address
+// -- binbuf  - binary data
+// -- binlen  - number of binary data bytes
+static void
+emit_data(uint32_t address, const byte_type *binbuf, int binlen) {
+    while (binlen > 0) {
+        // -- start a new record if full, not contiguous or at a 64K boundary
+        if (pending_len == record_length ||
+            address != pending_address + pending_len ||
+            (pending_len > 0 && (address & 0xFFFF) == 0)) {
+            flush_pending();
+        }
+        if (pending_len == 0) pending_address = address;
+
+        // -- keep each record within one 64K segment
+        uint32_t count = record_length - pending_len;
+        if (count > (uint32_t) binlen) count = binlen;
+        if (count > 0x10000 - (address & 0xFFFF)) {
+            count = 0x10000 - (address & 0xFFFF);
+        }
+
+        memcpy(pending + pending_len, binbuf, count);
+        pending_len += count;
+        address += count;
+        binbuf += count;
+        binlen -= count;
+    }
+}
+
+//
+// -- buffer a data record for sorting
+// -- address - linear load address
+// -- binbuf  - binary data
+// -- binlen  - number of binary data bytes
+static void
+buffer_data(uint32_t address, const byte_type *binbuf, int binlen) {
+    // -- grow the record list and the data area as needed
+    if (sort_count == sort_capacity) {
+        sort_capacity = sort_capacity ? 2 * sort_capacity : 1024;
+        sort_list = realloc(sort_list, sort_capacity * sizeof(sort_record));
+        if (!sort_list) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (sort_data_size + binlen > sort_data_capacity) {
+        sort_data_capacity = sort_data_capacity ? 2 * sort_data_capacity : 65536;
+        sort_data = realloc(sort_data, sort_data_capacity);
+        if (!sort_data) {
+            perror("malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    sort_record *record = &sort_list[sort_count];
+    record->address = address;
+    record->index = sort_count;
+    record->binlen = binlen;
+    record->position = sort_data_size;
+    memcpy(sort_data + sort_data_size, binbuf, binlen);
+    sort_data_size += binlen;
+    ++sort_count;
+}
+
+//
+// -- order data records by address, then by input order
+static int
+compare_records(const void *lhs, const void *rhs) {
+    const sort_record *a = lhs;
+    const sort_record *b = rhs;
+    if (a->address != b->address) return a->address < b->address ? -1 : 1;
+    return a->index - b->index;
+}
+
+//
+// -- return the 32-bit start address of a start address record
+static uint32_t
+start_address(const byte_type *binbuf) {
+    return ((uint32_t) binbuf[0] << 24) | ((uint32_t) binbuf[1] << 16) |
+           ((uint32_t) binbuf[2] << 8) | binbuf[3];
+}
+
+//
+// -- main program
+int
+main(int argc, char *argv[]) {
+    out_fp = stdout;
+    // -- process command line arguments
+    int option_index = 0;
+    int ch;
+    while ((ch = getopt_long(argc, argv,
+                             short_options, long_options,
+                             &option_index)) != -1) {
+        switch (ch) {
+            case 'l':
+                // -- record length
+                record_length = strtobyte(optarg);
+                if (record_length == 0) {
+                    fprintf(stderr, "invalid record length\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'o':
+                // -- output
+                out_fp = fopen(optarg, "w");
+                if (!out_fp) {
+                    perror("open");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 's':
+                // -- sort
+                sort_records = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    argv += optind;
+
+    // -- open input file
+    char *path = argv[0];
+    if (!path || strcmp(path, "-") == 0) {
+        in_fp = stdin;
+    } else {
+        in_fp = fopen(path, "r");
+        if (!in_fp) {
+            perror("open");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    //
+    // -- parse the input, streaming data records to the output unless sorting
+    int read_count;
+    int line_count = 0;
+    while ((read_count = (int) getline(&line, &line_size, in_fp)) > 0) {
+        ++line_count;
+
+        // -- parse a record
+        int status = parse_record(line, read_count,
+                                  data, k_max_data,
+                                  &offset,
+                                  &reclen);
+
+        if (status == -3) {
+            fprintf(stderr, "line %d: line too long\n", line_count);
+            exit(EXIT_FAILURE);
+        } else if (status == -2 || status == -1) {
+            ++warning_count;
+            if (warning_count < k_max_warnings) {
+                fprintf(stderr, "line %d: invalid record format\n", line_count);
+            } else if (warning_count == k_max_warnings) {
+                fprintf(stderr, "line %d: too many warnings, will no longer report\n", line_count);
+            }
+        } else if (status == 0) {
+            // -- data record
+            uint32_t address = (in_ulba << 16) + (in_usba << 4) + offset;
+            if (sort_records) {
+                buffer_data(address, data, reclen);
+            } else {
+                emit_data(address, data, reclen);
+            }
+        } else if (status == 1) {
+            // -- eof record
+            // -- exit loop
+            eof_address = offset;
+            break;
+        } else if (status == 2) {
+            // -- extended linear address record
+            // -- only tracked, written again as needed by flush_pending
+            in_ulba = offset;
+            in_usba = 0;
+        } else if (status == 6) {
+            // -- extended segment address record
+            // -- converted to linear addresses
+            in_usba = offset;
+            in_ulba = 0;
+        } else if (status == 4) {
+            // -- start segment address record
+            has_ssa = true;
+            ssa_address = start_address(data);
+        } else if (status == 5) {
+            // -- start linear address record
+            has_sla = true;
+            sla_address = start_address(data);
+        }
+        // -- otherwise skip line
+    }
+    // -- check for read errors
+    if (ferror(in_fp)) {
+        perror("read");
+        exit(EXIT_FAILURE);
+    }
+
+    //
+    // -- write the sorted data records
+    if (sort_records) {
+        qsort(sort_list, sort_count, sizeof(sort_record), compare_records);
+        for (int i = 0; i < sort_count; ++i) {
+            emit_data(sort_list[i].address,
+                      sort_data + sort_list[i].position,
+                      sort_list[i].binlen);
+        }
+    }
+    flush_pending();
+
+    //
+    // -- write the start address records and mark end of file
+    if (has_ssa) write_ssa_record(out_fp, ssa_address);
+    if (has_sla) write_sla_record(out_fp, sla_address);
+    write_eof_record(out_fp, eof_address);
+    check_output();
+
+    //
+    // -- close and return
+    fclose(in_fp);
+    fclose(out_fp);
+    return EXIT_SUCCESS;
+}
@@ -64,21 +64,6 @@ chars_to_uint16(const char *record) {
     return (word_type) result;
 }
 
-// -- convert eight ASCII hexadecimal characters to their value
-static uint32_t
-chars_to_uint32(const char *record) {
-    uint32_t result;
-    result  = char_to_uint8(record[0]) << 28;
-    result += char_to_uint8(record[1]) << 24;
-    result += char_to_uint8(record[2]) << 20;
-    result += char_to_uint8(record[3]) << 16;
-    result += char_to_uint8(record[4]) << 12;
-    result += char_to_uint8(record[5]) << 8;
-    result += char_to_uint8(record[6]) << 4;
-    result += char_to_uint8(record[7]);
-    return result;
-}
-
 //
 // -- generate the Intel hex format checksum
 // -- checksum - initial checksum
@@ -95,6 +80,41 @@ gen_checksum(byte_type checksum,
     return checksum;
 }
 
+//
+// -- write an Intel hex format start address record
+// -- fp      - output file pointer
+// -- rectyp  - start segment or start linear address record type
+// -- address - 32-bit start address
+static void
+write_start_record(FILE *fp, byte_type rectyp, uint32_t address) {
+    assert(fp && "null file pointer");
+    static const int k_startlen = 4;
+
+    byte_type hdrbuf[k_hdrlen + k_startlen];
+    // -- set record length
+    hdrbuf[0] = (byte_type) k_startlen;
+    // -- set load offset
+    hdrbuf[1] = high_byte(0);
+    hdrbuf[2] = low_byte(0);
+    // -- set the record type
+    hdrbuf[3] = rectyp;
+    // -- start address
+    hdrbuf[4] = high_byte((word_type) (address >> 16));
+    hdrbuf[5] = low_byte((word_type) (address >> 16));
+    hdrbuf[6] = high_byte((word_type) address);
+    hdrbuf[7] = low_byte((word_type) address);
+
+    // -- generate the checksum
+    byte_type checksum = -gen_checksum(0, hdrbuf, k_hdrlen + k_startlen);
+
+    // -- and output
+    fprintf(fp, ":");
+    for (int i = 0; i < k_hdrlen + k_startlen; ++i) {
+        fprintf(fp, "%02X", hdrbuf[i] & 0xFF);
+    }
+    fprintf(fp, "%02X\n", checksum & 0xFF);
+}
+
 //
 // -- public functions
 //
@@ -169,6 +189,24 @@ write_ela_record(FILE *fp, address_type ulba) {
     fprintf(fp, "%02X\n", checksum & 0xFF);
 }
 
+//
+// -- write an Intel hex format start segment address record
+// -- fp     - output file pointer
+// -- cs_ip  - code segment (upper 16 bits) and instruction pointer
+void
+write_ssa_record(FILE *fp, uint32_t cs_ip) {
+    write_start_record(fp, k_ssa_record_type, cs_ip);
+}
+
+//
+// -- write an Intel hex format start linear address record
+// -- fp     - output file pointer
+// -- eip    - extended instruction pointer
+void
+write_sla_record(FILE *fp, uint32_t eip) {
+    write_start_record(fp, k_sla_record_type, eip);
+}
+
 //
 // -- write an Intel hex format end of file record
 // -- fp     - output file pointer
@@ -207,8 +245,13 @@ write_eof_record(FILE *fp, address_type start) {
 // --               returned start address in an end of file record
 // --               returned upper linear base address in an extended linear
 // --                 address record
+// --               returned upper segment base address in an extended segment
+// --                 address record
 // -- p_binlen  - pointer for the returned number of binary data bytes
 //
+// -- a start address record returns its four address bytes (CS:IP or EIP)
+// -- in binbuf, most significant byte first
+//
 // -- return -3 if the buffer is not large enough to receive the binary data
 // -- return -2 if an invalid record format
 // -- return -1 if the record is empty or doesn't start with a record mark
@@ -216,6 +259,9 @@ write_eof_record(FILE *fp, address_type start) {
 // -- return  1 if a valid end of file record
 // -- return  2 if a valid extended linear address record
 // -- return  3 if a valid yet ignorable record
+// -- return  4 if a valid start segment address record
+// -- return  5 if a valid start linear address record
+// -- return  6 if a valid extended segment address record
 int
 parse_record(const char *hexbuf, int hexsize,
              byte_type *binbuf, int binsize,
@@ -226,8 +272,6 @@ parse_record(const char *hexbuf, int hexsize,
     // -- 16-bit and 32-bit record type data
     uint16_t ulba = 0;
     uint16_t usba = 0;
-    uint32_t eip = 0;
-    uint32_t cs_ip = 0;
 
     // -- record is empty or doesn't start with a record mark
     if (hexsize < 1 || hexbuf[0] != ':') return -1;
@@ -284,17 +328,27 @@ parse_record(const char *hexbuf, int hexsize,
 
         case k_esa_record_type:
             // -- extended segment address record
+            assert(p_address && "null address pointer");
+
             if (reclen != 2) return -1;
             if (offset != 0) return -1;
             usba = chars_to_uint16(&hexbuf[9]);
-            return 3;
+            *p_address = usba;
+            return 6;
 
         case k_ssa_record_type:
             // -- start segment address record
+            assert(binbuf && "null binbuf pointer");
+            assert(p_binlen && "null reclen pointer");
+
             if (reclen != 4) return -1;
             if (offset != 0) return -1;
-            cs_ip = chars_to_uint32(&hexbuf[9]);
-            return 3;
+            if (binsize < reclen) return -3;
+            for (int i = 0; i < reclen; ++i) {
+                binbuf[i] = chars_to_uint8(&hexbuf[9+2*i]);
+            }
+            *p_binlen = reclen;
+            return 4;
 
         case k_ela_record_type:
             // -- extended linear address record
@@ -308,10 +362,17 @@ parse_record(const char *hexbuf, int hexsize,
 
         case k_sla_record_type:
             // -- start linear address record
+            assert(binbuf && "null binbuf pointer");
+            assert(p_binlen && "null reclen pointer");
+
             if (reclen != 4) return -1;
             if (offset != 0) return -1;
-            eip = chars_to_uint32(&hexbuf[9]);
-            return 3;
+            if (binsize < reclen) return -3;
+            for (int i = 0; i < reclen; ++i) {
+                binbuf[i] = chars_to_uint8(&hexbuf[9+2*i]);
+            }
+            *p_binlen = reclen;
+            return 5;
 
         default:
             // -- illegal record type
@@ -24,6 +24,20 @@ write_data_record(FILE *fp,
 void
 write_ela_record(FILE *fp, address_type ulba);
 
+//
+// -- write an Intel hex format start segment address record
+// -- fp     - output file pointer
+// -- cs_ip  - code segment (upper 16 bits) and instruction pointer
+void
+write_ssa_record(FILE *fp, uint32_t cs_ip);
+
+//
+// -- write an Intel hex format start linear address record
+// -- fp     - output file pointer
+// -- eip    - extended instruction pointer
+void
+write_sla_record(FILE *fp, uint32_t eip);
+
 //
 // -- write an Intel hex format end of file record
 // -- fp     - output file pointer
@@ -41,8 +55,13 @@ write_eof_record(FILE *fp, address_type start);
 // --               returned start address in an end of file record
 // --               returned upper linear base address in an extended linear
 // --                 address record
+// --               returned upper segment base address in an extended segment
+// --                 address record
 // -- p_binlen  - pointer for the returned number of binary data bytes
 //
+// -- a start address record returns its four address bytes (CS:IP or EIP)
+// -- in binbuf, most significant byte first
+//
 // -- return -3 if the buffer is not large enough to receive the binary data
 // -- return -2 if an invalid record format
 // -- return -1 if the record is empty or doesn't start with a record mark
@@ -50,6 +69,9 @@ write_eof_record(FILE *fp, address_type start);
 // -- return  1 if a valid end of file record
 // -- return  2 if a valid extended linear address record
 // -- return  3 if a valid yet ignorable record
+// -- return  4 if a valid start segment address record
+// -- return  5 if a valid start linear address record
+// -- return  6 if a valid extended segment address record
 int
 parse_record(const char *hexbuf, int hexsize,
              byte_type *binbuf, int binsize,
@@ -0,0 +1,221 @@
+//
+// -- split.c
+//
+#include "split.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// -- scan for a number
+// -- str     - number with optional radix tag (B, D, O, Q or H)
+// -- limit   - largest valid value
+// -- message - error message for an invalid number
+//
+// -- exit the program if the number is invalid
+static uint32_t
+scan_number(const char *str, uint32_t limit, const char *message) {
+    const char *ptr = str;
+    unsigned int radix = 10;
+    // -- advance past hexadecimal digits
+    while (isxdigit(*ptr)) {
+        ++ptr;
+    }
+    // -- test for radix tag
+    if (toupper(*ptr) == 'O' || toupper(*ptr) == 'Q') {
+        radix = 8;
+    } else if (toupper(*ptr) == 'H') {
+        radix = 16;
+    } else {
+        --ptr;
+        if (toupper(*ptr) == 'B') {
+            radix = 2;
+        } else if (toupper(*ptr) == 'D') {
+            radix = 10;
+        } else {
+            ++ptr;
+        }
+    }
+    
+    unsigned int value = 0;
+    while (str < ptr) {
+        int ch = toupper(*str++);
+        unsigned int digit = (ch >= 'A') ? (ch - 'A' + 10) : (ch - '0');
+        value = value * radix + digit;
+        if (digit >= radix || value > limit) {
+            fprintf(stderr, "%s\n", message);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return value;
+}
+
+//
+// -- scan for an address
+// -- str - address with optional radix tag (B, D, O, Q or H)
+//
+// -- exit the program if the address is invalid
+address_type
+strtoaddr(const char *str) {
+    return (address_type) scan_number(str, k_address_limit - 1,
+                                       "invalid address");
+}
+
+//
+// -- scan for a byte value
+// -- str - value with optional radix tag (B, D, O, Q or H)
+//
+// -- exit the program if the value is invalid
+byte_type
+strtobyte(const char *str) {
+    address_type value = strtoaddr(str);
+    if (value > 0xFF) {
+        fprintf(stderr, "invalid byte value\n");
+        exit(EXIT_FAILURE);
+    }
+    return (byte_type) value;
+}
+
+//
+// -- parse a chunk size
+// -- str    - chunk size, typically the erase sector or device size,
+// --            up to the whole address space
+// -- p_spec - pointer to the split specification to fill in
+//
+// -- exit the program if the size is invalid
+void
+parse_size(const char *str, split_spec *p_spec) {
+    assert(str && "null string pointer");
+    assert(p_spec && "null spec pointer");
+
+    p_spec->size = scan_number(str, k_address_limit, "invalid split size");
+    if (p_spec->size == 0) {
+        fprintf(stderr, "invalid split size\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+// -- parse a comma separated list of bank boundary addresses
+// -- str    - list of addresses
+// -- p_spec - pointer to the split specification to fill in
+//
+// -- exit the program if the list is invalid
+void
+parse_banks(const char *str, split_spec *p_spec) {
+    assert(str && "null string pointer");
+    assert(p_spec && "null spec pointer");
+
+    char *list = strdup(str);
+    if (!list) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    p_spec->bank_count = 0;
+    for (char *token = strtok(list, ","); token; token = strtok(NULL, ",")) {
+        if (p_spec->bank_count == k_max_banks) {
+            fprintf(stderr, "too many banks\n");
+            exit(EXIT_FAILURE);
+        }
+        uint32_t bank = strtoaddr(token);
+        // -- boundaries must be given in ascending order
+        if (p_spec->bank_count > 0 &&
+            bank <= p_spec->banks[p_spec->bank_count - 1]) {
+            fprintf(stderr, "bank addresses must be ascending\n");
+            exit(EXIT_FAILURE);
+        }
+        p_spec->banks[p_spec->bank_count++] = bank;
+    }
+    free(list);
+
+    // -- an empty list would silently disable the split
+    if (p_spec->bank_count == 0) {
+        fprintf(stderr, "invalid bank list\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+//
+// -- test if a split specification is in effect
+// -- p_spec - pointer to the split specification
+bool
+split_enabled(const split_spec *p_spec) {
+    assert(p_spec && "null spec pointer");
+    return p_spec->size != 0 || p_spec->bank_count != 0;
+}
+
+//
+// -- return the end (exclusive) of the chunk containing an address
+// -- p_spec  - pointer to the split specification
+// -- address - address within the chunk
+uint32_t
+chunk_end(const split_spec *p_spec, uint32_t address) {
+    assert(p_spec && "null spec pointer");
+    uint32_t end = k_address_limit;
+
+    // -- next multiple of the chunk size
+    if (p_spec->size != 0) {
+        uint32_t next = (address / p_spec->size + 1) * p_spec->size;
+        if (end > next) end = next;
+    }
+    // -- next bank boundary
+    for (int i = 0; i < p_spec->bank_count; ++i) {
+        if (p_spec->banks[i] > address) {
+            if (end > p_spec->banks[i]) end = p_spec->banks[i];
+            break;
+        }
+    }
+    return end;
+}
+
+//
+// -- test if a chunk holds nothing but the fill byte
+// -- binbuf - binary data
+// -- binlen - number of binary data bytes
+// -- fill   - fill byte
+bool
+chunk_is_fill(const byte_type *binbuf, int binlen, byte_type fill) {
+    assert(binbuf && "null buffer");
+    for (int i = 0; i < binlen; ++i) {
+        if (binbuf[i] != fill) return false;
+    }
+    return true;
+}
+
+//
+// -- open the output file for a chunk
+// -- path - base output path, the chunk base address is inserted
+// --          before the extension (image.bin -> image_F000.bin)
+// -- base - chunk base address
+//
+// -- exit the program if the file cannot be opened
+FILE *
+open_chunk(const char *path, uint32_t base) {
+    assert(path && "null path pointer");
+
+    // -- locate the extension, ignoring dots in directory names
+    const char *name = strrchr(path, '/');
+    const char *ext = strrchr(name ? name : path, '.');
+    int stem = ext ? (int) (ext - path) : (int) strlen(path);
+    if (!ext) ext = "";
+
+    // -- stem, underscore, four hex digits, extension, terminator
+    size_t size = stem + 1 + 4 + strlen(ext) + 1;
+    char *chunk_path = malloc(size);
+    if (!chunk_path) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(chunk_path, size, "%.*s_%04X%s", stem, path, base, ext);
+
+    FILE *fp = fopen(chunk_path, "w");
+    if (!fp) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+    free(chunk_path);
+    return fp;
+}
@@ -0,0 +1,91 @@
+//
+// -- split.h
+//
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include "types.h"
+
+// -- maximum number of explicit bank boundaries
+enum { k_max_banks = 64 };
+// -- end of the address space
+enum { k_address_limit = 0x10000 };
+
+//
+// -- output split specification
+// -- size       - chunk size, chunks start at multiples of size (0 if unused)
+// -- banks      - ascending bank boundary addresses
+// -- bank_count - number of bank boundaries (0 if unused)
+typedef struct split_spec {
+    uint32_t size;
+    uint32_t banks[k_max_banks];
+    int bank_count;
+} split_spec;
+
+//
+// -- scan for an address
+// -- str - address with optional radix tag (B, D, O, Q or H)
+//
+// -- exit the program if the address is invalid
+address_type
+strtoaddr(const char *str);
+
+//
+// -- scan for a byte value
+// -- str - value with optional radix tag (B, D, O, Q or H)
+//
+// -- exit the program if the value is invalid
+byte_type
+strtobyte(const char *str);
+
+//
+// -- parse a chunk size
+// -- str    - chunk size, typically the erase sector or device size,
+// --            up to the whole address space
+// -- p_spec - pointer to the split specification to fill in
+//
+// -- exit the program if the size is invalid
+void
+parse_size(const char *str, split_spec *p_spec);
+
+//
+// -- parse a comma separated list of bank boundary addresses
+// -- str    - list of addresses
+// -- p_spec - pointer to the split specification to fill in
+//
+// -- exit the program if the list is invalid
+void
+parse_banks(const char *str, split_spec *p_spec);
+
+//
+// -- test if a split specification is in effect
+// -- p_spec - pointer to the split specification
+bool
+split_enabled(const split_spec *p_spec);
+
+//
+// -- return the end (exclusive) of the chunk containing an address
+// -- p_spec  - pointer to the split specification
+// -- address - address within the chunk
+uint32_t
+chunk_end(const split_spec *p_spec, uint32_t address);
+
+//
+// -- test if a chunk holds nothing but the fill byte
+// -- binbuf - binary data
+// -- binlen - number of binary data bytes
+// -- fill   - fill byte
+bool
+chunk_is_fill(const byte_type *binbuf, int binlen, byte_type fill);
+
+//
+// -- open the output file for a chunk
+// -- path - base output path, the chunk base address is inserted
+// --          before the extension (image.bin -> image_F000.bin)
+// -- base - chunk base address
+//
+// -- exit the program if the file cannot be opened
+FILE *
+open_chunk(const char *path, uint32_t base);
+
+#endif